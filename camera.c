@@ -1,4 +1,5 @@
 #include "camera.h"
+#include "prof.h"
 #include "utils.h"
 #include <SDL2/SDL.h>
 #include <float.h>
@@ -90,6 +91,7 @@ void sphere_write(sphere_t *sphere) {
   float cam_z = (scene.camera.f > 0)
                     ? -scene.camera.f
                     : scene.camera.f; // The camera looks along the -Z direction
+  PROF_COUNT(PROF_SPHERES_RASTERIZED, 1);
   for (int x = floor(origin.x - rad); x <= ceil(origin.x + rad); ++x) {
     for (int y = floor(origin.y - rad); y <= ceil(origin.y + rad); ++y) {
       float dx = x - origin.x;
@@ -121,6 +123,7 @@ void sphere_write(sphere_t *sphere) {
         int px = projected.x;
         int py = projected.y;
         dbuffer_write(px, py, depth, u32_color);
+        PROF_COUNT(PROF_PIXELS_RASTERIZED, 1);
       }
     }
   }
@@ -0,0 +1,163 @@
+#include "cluster.h"
+#include "oct.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+static int radial_bin(double r);
+static double radial_bin_upper(int bin);
+static double fit_slope(const double *x, const double *y, int count);
+static void samples_push(cluster_stats_t *stats, cluster_sample_t sample);
+
+// shells grow geometrically; bin 0 starts at the seed itself
+static int radial_bin(double r) {
+  int bin = (int)(RADIAL_BINS_PER_OCTAVE * log2(1.0 + r));
+  return bin < RADIAL_BINS ? bin : RADIAL_BINS - 1;
+}
+
+static double radial_bin_upper(int bin) {
+  return exp2((double)(bin + 1) / RADIAL_BINS_PER_OCTAVE) - 1.0;
+}
+
+// least squares slope of y over x, NAN without at least two points
+static double fit_slope(const double *x, const double *y, int count) {
+  if (count < 2)
+    return NAN;
+  double sx = 0, sy = 0, sxx = 0, sxy = 0;
+  for (int i = 0; i < count; ++i) {
+    sx += x[i];
+    sy += y[i];
+    sxx += x[i] * x[i];
+    sxy += x[i] * y[i];
+  }
+  double denom = count * sxx - sx * sx;
+  return denom != 0.0 ? (count * sxy - sx * sy) / denom : NAN;
+}
+
+static void samples_push(cluster_stats_t *stats, cluster_sample_t sample) {
+  if (stats->sample_count == stats->sample_capacity) {
+    size_t capacity = stats->sample_capacity ? 2 * stats->sample_capacity : 64;
+    cluster_sample_t *samples =
+        realloc(stats->samples, capacity * sizeof(cluster_sample_t));
+    if (!samples) {
+      fprintf(stderr, "Memory allocation failed for cluster samples\n");
+      return;
+    }
+    stats->samples = samples;
+    stats->sample_capacity = capacity;
+  }
+  stats->samples[stats->sample_count++] = sample;
+}
+
+void cluster_stats_init(cluster_stats_t *stats, point_t seed,
+                        size_t sample_every) {
+  memset(stats, 0, sizeof(*stats));
+  stats->seed = seed;
+  stats->sample_every = sample_every;
+}
+
+void cluster_stats_free(cluster_stats_t *stats) {
+  free(stats->samples);
+  stats->samples = NULL;
+  stats->sample_count = stats->sample_capacity = 0;
+}
+
+void cluster_stats_add(cluster_stats_t *stats, const octree_t *octree,
+                       point_t point) {
+  double x = point.x - stats->seed.x;
+  double y = point.y - stats->seed.y;
+  double z = point.z - stats->seed.z;
+  double r2 = x * x + y * y + z * z;
+  double r = sqrt(r2);
+  stats->n++;
+  stats->sum_x += x;
+  stats->sum_y += y;
+  stats->sum_z += z;
+  stats->sum_r2 += r2;
+  if (r > stats->rmax)
+    stats->rmax = r;
+  stats->radial[radial_bin(r)]++;
+  if (stats->sample_every && stats->n % stats->sample_every == 0)
+    samples_push(stats, cluster_sample(stats, octree));
+}
+
+bool cluster_insert(cluster_stats_t *stats, octree_t *octree, point_t point) {
+  if (!octree_insert(octree, point))
+    return false;
+  cluster_stats_add(stats, octree, point);
+  return true;
+}
+
+double cluster_rg(const cluster_stats_t *stats) {
+  if (!stats->n)
+    return 0.0;
+  double n = stats->n;
+  double mx = stats->sum_x / n, my = stats->sum_y / n, mz = stats->sum_z / n;
+  double rg2 = stats->sum_r2 / n - (mx * mx + my * my + mz * mz);
+  return rg2 > 0.0 ? sqrt(rg2) : 0.0;
+}
+
+double cluster_mass_dim(const cluster_stats_t *stats, int *levels) {
+  // M(r) ~ r^D; skip the lattice-dominated core and the sparse outer shells
+  double x[RADIAL_BINS], y[RADIAL_BINS];
+  int count = 0;
+  size_t mass = 0;
+  for (int b = 0; b < RADIAL_BINS; ++b) {
+    mass += stats->radial[b];
+    double r = radial_bin_upper(b);
+    if (r > stats->rmax / 2)
+      break;
+    if (r < 2.0 || !mass)
+      continue;
+    x[count] = log(r);
+    y[count] = log((double)mass);
+    count++;
+  }
+  if (levels)
+    *levels = count;
+  return fit_slope(x, y, count);
+}
+
+double cluster_box_dim(const cluster_stats_t *stats, const octree_t *octree,
+                       int *levels) {
+  // N(s) ~ s^-D with the box side halving per level. Only boxes well below
+  // the cluster size are used: coarser ones are dominated by where the fixed
+  // octree grid happens to cut the cluster. Points still held by shallower
+  // leaves have no node at this depth yet; each adds at most one box, so
+  // they are counted as such and the fit stops once they would be more than
+  // a quarter of the level.
+  cuboid_t root = octree->root->boundary;
+  double side =
+      MAX(root.x1 - root.x0, MAX(root.y1 - root.y0, root.z1 - root.z0)) + 1;
+  double x[OCT_MAX_DEPTH], y[OCT_MAX_DEPTH];
+  int count = 0;
+  size_t shallow = octree->leaf_points[0];
+  for (int d = 1; d < OCT_MAX_DEPTH && side / 2 >= 1.0; ++d) {
+    side /= 2;
+    size_t boxes = octree->occupied[d];
+    if (!boxes || 4 * shallow > boxes)
+      break;
+    double estimate = boxes + shallow;
+    shallow += octree->leaf_points[d];
+    if (side > stats->rmax / 8)
+      continue;
+    x[count] = d * log(2.0);
+    y[count] = log(estimate);
+    count++;
+  }
+  if (levels)
+    *levels = count;
+  return fit_slope(x, y, count);
+}
+
+cluster_sample_t cluster_sample(const cluster_stats_t *stats,
+                                const octree_t *octree) {
+  cluster_sample_t sample = {stats->n, cluster_rg(stats), stats->rmax};
+  sample.mass_dim = cluster_mass_dim(stats, &sample.mass_levels);
+  sample.box_dim = cluster_box_dim(stats, octree, &sample.box_levels);
+  return sample;
+}
@@ -0,0 +1,56 @@
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include "oct.h"
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define RADIAL_BINS_PER_OCTAVE 4
+#define RADIAL_BINS (RADIAL_BINS_PER_OCTAVE * OCT_MAX_DEPTH)
+
+/** One entry of the cluster statistics time series */
+typedef struct {
+  size_t n;           // number of particles
+  double rg;          // radius of gyration
+  double rmax;        // distance of the farthest particle from the seed
+  double mass_dim;    // fractal dimension from mass-radius scaling
+  double box_dim;     // fractal dimension from octree box counting
+  int mass_levels;    // radial bins that went into mass_dim
+  int box_levels;     // octree levels that went into box_dim
+} cluster_sample_t;
+
+/**
+ * Cluster statistics updated in O(1) per inserted particle. Coordinates are
+ * kept relative to the seed so the running sums stay small.
+ */
+typedef struct {
+  point_t seed;
+  size_t n;
+  double sum_x, sum_y, sum_z;
+  double sum_r2;
+  double rmax;
+  size_t radial[RADIAL_BINS]; // particle count per log-spaced radial shell
+  size_t sample_every;
+  cluster_sample_t *samples;
+  size_t sample_count, sample_capacity;
+} cluster_stats_t;
+
+void cluster_stats_init(cluster_stats_t *stats, point_t seed,
+                        size_t sample_every);
+void cluster_stats_free(cluster_stats_t *stats);
+bool cluster_insert(cluster_stats_t *stats, octree_t *octree, point_t point);
+void cluster_stats_add(cluster_stats_t *stats, const octree_t *octree,
+                       point_t point);
+double cluster_rg(const cluster_stats_t *stats);
+/**
+ * Dimension estimates are NAN while fewer than two scales qualify for the
+ * fit, e.g. early in growth. If levels is not NULL it receives the number of
+ * scales that were fitted.
+ */
+double cluster_mass_dim(const cluster_stats_t *stats, int *levels);
+double cluster_box_dim(const cluster_stats_t *stats, const octree_t *octree,
+                       int *levels);
+cluster_sample_t cluster_sample(const cluster_stats_t *stats,
+                                const octree_t *octree);
+
+#endif // CLUSTER_H
@@ -0,0 +1,113 @@
+#include "cluster.h"
+#include "oct.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// Feeds shapes of known dimension through cluster_insert and checks the
+// estimates. The shapes are much smaller than the octree domain and not
+// aligned with it, as a growing cluster is. A branching shape keeps points in
+// shallow leaves near its center, so its box counting fit has to stop early.
+
+#define DOMAIN 1024
+#define TOLERANCE 0.15
+
+typedef struct {
+  const char *name;
+  int dim;
+  int sx, sy, sz; // extent along each axis
+  int stride;     // spacing between points
+  bool star;      // three orthogonal arms of length sx through the center
+  bool stops;     // the box counting fit must end at a shallow leaf
+} shape_t;
+
+static void shape_insert(shape_t shape, int offset, cluster_stats_t *stats,
+                         octree_t *octree) {
+  point_t c = stats->seed;
+  size_t id = 0;
+  if (shape.star) {
+    for (int t = -shape.sx / 2; t < shape.sx / 2; t += shape.stride) {
+      cluster_insert(stats, octree, (point_t){c.x + t, c.y, c.z, id++});
+      if (!t)
+        continue;
+      cluster_insert(stats, octree, (point_t){c.x, c.y + t, c.z, id++});
+      cluster_insert(stats, octree, (point_t){c.x, c.y, c.z + t, id++});
+    }
+    return;
+  }
+  for (int x = 0; x < shape.sx; x += shape.stride) {
+    for (int y = 0; y < shape.sy; y += shape.stride) {
+      for (int z = 0; z < shape.sz; z += shape.stride)
+        cluster_insert(stats, octree,
+                       (point_t){offset + x, offset + y, offset + z, id++});
+    }
+  }
+}
+
+// occupied levels with boxes below the cluster size; a fit that stops at a
+// shallow leaf uses fewer
+static int levels_available(const cluster_stats_t *stats,
+                            const octree_t *octree) {
+  int count = 0, side = DOMAIN / 2;
+  for (int d = 1; d < OCT_MAX_DEPTH && side >= 1; ++d, side /= 2)
+    count += octree->occupied[d] && side <= stats->rmax / 8;
+  return count;
+}
+
+static bool check(shape_t shape, int offset) {
+  cuboid_t boundary = {0, 0, 0, DOMAIN - 1, DOMAIN - 1, DOMAIN - 1};
+  octree_t octree = {.root = node_new(&boundary)};
+  point_t seed = {offset + shape.sx / 2, offset + shape.sy / 2,
+                  offset + shape.sz / 2, 0};
+  cluster_stats_t stats;
+  cluster_stats_init(&stats, seed, 0);
+  shape_insert(shape, offset, &stats, &octree);
+  int mass_levels, box_levels;
+  double mass_dim = cluster_mass_dim(&stats, &mass_levels);
+  double box_dim = cluster_box_dim(&stats, &octree, &box_levels);
+  bool stopped = box_levels < levels_available(&stats, &octree);
+  bool ok = fabs(mass_dim - shape.dim) < TOLERANCE &&
+            fabs(box_dim - shape.dim) < TOLERANCE && stopped == shape.stops;
+  printf("%-12s at %4d: mass_dim %.2f (%d bins), box_dim %.2f (%d levels%s) "
+         "(expected %d) %s\n",
+         shape.name, offset, mass_dim, mass_levels, box_dim, box_levels,
+         stopped ? ", stopped early" : "", shape.dim, ok ? "ok" : "FAILED");
+  cluster_stats_free(&stats);
+  octree_free(&octree);
+  return ok;
+}
+
+// too few qualifying scales must read as no estimate rather than 0
+static bool check_too_few_levels(void) {
+  cuboid_t boundary = {0, 0, 0, DOMAIN - 1, DOMAIN - 1, DOMAIN - 1};
+  octree_t octree = {.root = node_new(&boundary)};
+  shape_t line = {"sparse line", 1, 256, 1, 1, 8, false, true};
+  cluster_stats_t stats;
+  cluster_stats_init(&stats, (point_t){300 + 128, 300, 300, 0}, 0);
+  shape_insert(line, 300, &stats, &octree);
+  int box_levels;
+  double box_dim = cluster_box_dim(&stats, &octree, &box_levels);
+  bool ok = isnan(box_dim) && box_levels < 2;
+  printf("%-12s at  300: box_dim %.2f (%d levels) (expected nan) %s\n",
+         line.name, box_dim, box_levels, ok ? "ok" : "FAILED");
+  cluster_stats_free(&stats);
+  octree_free(&octree);
+  return ok;
+}
+
+int main() {
+  const shape_t shapes[] = {
+      {"line", 1, 256, 1, 1, 1, false, false},
+      {"plane", 2, 256, 256, 1, 1, false, false},
+      {"cube", 3, 64, 64, 64, 1, false, false},
+      {"star", 1, 512, 1, 1, 1, true, true},
+      {"sparse plane", 2, 256, 256, 1, 4, false, false}};
+  const int offsets[] = {0, 300, 512, 517};
+  bool ok = true;
+  for (size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); ++i) {
+    for (int j = 0; j < 4; ++j)
+      ok &= check(shapes[i], offsets[j]);
+  }
+  ok &= check_too_few_levels();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,340 @@
+#include "coct.h"
+#include "oct.h"
+#include <float.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// try to advance the global epoch after this many retirements
+#define RETIRE_BATCH 64
+
+static cbody_t *body_leaf(size_t count);
+static cnode_t *cnode_new(cuboid_t boundary, cbody_t *body);
+static cbody_t *body_leaf_with(const cbody_t *leaf, point_t point);
+static cbody_t *body_branch_from(cnode_t *node, const cbody_t *leaf);
+static void body_discard(cbody_t *body);
+static bool cuboid_divisible(cuboid_t cuboid);
+static double cuboid_distance_sq(cuboid_t cuboid, point_t point);
+static void epoch_enter(coct_thread_t *thread);
+static void epoch_leave(coct_thread_t *thread);
+static void epoch_try_advance(coctree_t *tree);
+static void retire(coct_thread_t *thread, cbody_t *body);
+static void limbo_free(retired_t *list);
+
+// squared distance from a point to the closest point of a cuboid
+static double cuboid_distance_sq(cuboid_t cuboid, point_t point) {
+  double dx = point.x < cuboid.x0   ? cuboid.x0 - point.x
+              : point.x > cuboid.x1 ? point.x - cuboid.x1
+                                    : 0;
+  double dy = point.y < cuboid.y0   ? cuboid.y0 - point.y
+              : point.y > cuboid.y1 ? point.y - cuboid.y1
+                                    : 0;
+  double dz = point.z < cuboid.z0   ? cuboid.z0 - point.z
+              : point.z > cuboid.z1 ? point.z - cuboid.z1
+                                    : 0;
+  return dx * dx + dy * dy + dz * dz;
+}
+
+static bool cuboid_divisible(cuboid_t cuboid) {
+  return cuboid.x1 > cuboid.x0 || cuboid.y1 > cuboid.y0 ||
+         cuboid.z1 > cuboid.z0;
+}
+
+static cbody_t *body_leaf(size_t count) {
+  cbody_t *body = malloc(sizeof(cbody_t) + count * sizeof(point_t));
+  if (!body) {
+    fprintf(stderr, "Memory allocation failed for octree node\n");
+    abort();
+  }
+  body->is_branch = false;
+  for (int i = 0; i < 8; ++i)
+    body->children[i] = NULL;
+  body->count = count;
+  return body;
+}
+
+static cnode_t *cnode_new(cuboid_t boundary, cbody_t *body) {
+  cnode_t *node = malloc(sizeof(cnode_t));
+  if (!node) {
+    fprintf(stderr, "Memory allocation failed for octree node\n");
+    abort();
+  }
+  node->boundary = boundary;
+  atomic_init(&node->body, body);
+  return node;
+}
+
+// bodies are immutable once published, so an insert copies the leaf
+static cbody_t *body_leaf_with(const cbody_t *leaf, point_t point) {
+  cbody_t *body = body_leaf(leaf->count + 1);
+  memcpy(body->points, leaf->points, leaf->count * sizeof(point_t));
+  body->points[leaf->count] = point;
+  return body;
+}
+
+// the children are complete before the branch can be published
+static cbody_t *body_branch_from(cnode_t *node, const cbody_t *leaf) {
+  cuboid_t subcuboids[8];
+  size_t counts[8] = {0};
+  cuboid_divide(&node->boundary, subcuboids);
+  for (size_t i = 0; i < leaf->count; ++i)
+    counts[point_get_octant(node->boundary, leaf->points[i])]++;
+
+  cbody_t *child_bodies[8];
+  for (int i = 0; i < 8; ++i) {
+    child_bodies[i] = body_leaf(counts[i]);
+    child_bodies[i]->count = 0;
+  }
+  for (size_t i = 0; i < leaf->count; ++i) {
+    cbody_t *child =
+        child_bodies[point_get_octant(node->boundary, leaf->points[i])];
+    child->points[child->count++] = leaf->points[i];
+  }
+
+  cbody_t *body = body_leaf(0);
+  body->is_branch = true;
+  for (int i = 0; i < 8; ++i)
+    body->children[i] = cnode_new(subcuboids[i], child_bodies[i]);
+  return body;
+}
+
+// frees a body that lost its CAS and was never visible to other threads
+static void body_discard(cbody_t *body) {
+  if (body->is_branch) {
+    for (int i = 0; i < 8; ++i) {
+      free(atomic_load_explicit(&body->children[i]->body,
+                                memory_order_relaxed));
+      free(body->children[i]);
+    }
+  }
+  free(body);
+}
+
+static void epoch_enter(coct_thread_t *thread) {
+  unsigned long epoch = atomic_load(&thread->tree->epoch);
+  atomic_store(&thread->local_epoch, (epoch << 1) | 1);
+  // the announcement must be visible before any body pointer is loaded, or a
+  // reclaimer could miss this thread and free a body it is about to read
+  atomic_thread_fence(memory_order_seq_cst);
+}
+
+static void epoch_leave(coct_thread_t *thread) {
+  atomic_store_explicit(&thread->local_epoch, 0, memory_order_release);
+}
+
+// the epoch moves on only once every active thread has observed it
+static void epoch_try_advance(coctree_t *tree) {
+  unsigned long epoch = atomic_load(&tree->epoch);
+  // pairs with the fence in epoch_enter: either the scan sees a thread's
+  // announcement, or that thread sees every unlink made before this point
+  atomic_thread_fence(memory_order_seq_cst);
+  for (int i = 0; i < COCT_MAX_THREADS; ++i) {
+    coct_thread_t *thread = &tree->threads[i];
+    if (!atomic_load(&thread->in_use))
+      continue;
+    unsigned long local = atomic_load(&thread->local_epoch);
+    if ((local & 1) && (local >> 1) != epoch)
+      return;
+  }
+  atomic_compare_exchange_strong(&tree->epoch, &epoch, epoch + 1);
+}
+
+static void limbo_free(retired_t *list) {
+  while (list) {
+    retired_t *next = list->next;
+    free(list->body);
+    free(list);
+    list = next;
+  }
+}
+
+// a body retired in epoch e is unreachable for readers once the epoch is e+2
+static void retire(coct_thread_t *thread, cbody_t *body) {
+  if (++thread->retire_count % RETIRE_BATCH == 0)
+    epoch_try_advance(thread->tree);
+  unsigned long epoch = atomic_load(&thread->tree->epoch);
+  for (int i = 0; i < 3; ++i) {
+    if (thread->limbo[i] && thread->limbo_epoch[i] + 2 <= epoch) {
+      limbo_free(thread->limbo[i]);
+      thread->limbo[i] = NULL;
+    }
+  }
+  int bucket = epoch % 3;
+  if (thread->limbo[bucket] && thread->limbo_epoch[bucket] != epoch) {
+    limbo_free(thread->limbo[bucket]);
+    thread->limbo[bucket] = NULL;
+  }
+  retired_t *entry = malloc(sizeof(retired_t));
+  if (!entry) {
+    fprintf(stderr, "Memory allocation failed for retired node\n");
+    abort();
+  }
+  *entry = (retired_t){body, thread->limbo[bucket]};
+  thread->limbo[bucket] = entry;
+  thread->limbo_epoch[bucket] = epoch;
+}
+
+coctree_t *coctree_new(cuboid_t boundary) {
+  // sizeof is a multiple of the handle alignment, as aligned_alloc requires
+  coctree_t *tree = aligned_alloc(COCT_CACHE_LINE, sizeof(coctree_t));
+  if (!tree) {
+    fprintf(stderr, "Memory allocation failed for octree\n");
+    return NULL;
+  }
+  tree->root = cnode_new(boundary, body_leaf(0));
+  atomic_init(&tree->epoch, 0);
+  for (int i = 0; i < COCT_MAX_THREADS; ++i) {
+    coct_thread_t *thread = &tree->threads[i];
+    atomic_init(&thread->in_use, false);
+    atomic_init(&thread->local_epoch, 0);
+    for (int j = 0; j < 3; ++j) {
+      thread->limbo[j] = NULL;
+      thread->limbo_epoch[j] = 0;
+    }
+    thread->retire_count = 0;
+    thread->tree = tree;
+  }
+  return tree;
+}
+
+static void cnode_free(cnode_t *node) {
+  cbody_t *body = atomic_load_explicit(&node->body, memory_order_relaxed);
+  if (body->is_branch) {
+    for (int i = 0; i < 8; ++i)
+      cnode_free(body->children[i]);
+  }
+  free(body);
+  free(node);
+}
+
+// no thread may use the tree any more
+void coctree_free(coctree_t *tree) {
+  if (!tree)
+    return;
+  cnode_free(tree->root);
+  for (int i = 0; i < COCT_MAX_THREADS; ++i) {
+    for (int j = 0; j < 3; ++j)
+      limbo_free(tree->threads[i].limbo[j]);
+  }
+  free(tree);
+}
+
+coct_thread_t *coctree_thread_register(coctree_t *tree) {
+  for (int i = 0; i < COCT_MAX_THREADS; ++i) {
+    bool expected = false;
+    if (atomic_compare_exchange_strong(&tree->threads[i].in_use, &expected,
+                                       true))
+      return &tree->threads[i];
+  }
+  fprintf(stderr, "Too many threads registered with the octree\n");
+  return NULL;
+}
+
+// pending retirements stay with the slot and are reclaimed by its next owner
+void coctree_thread_unregister(coct_thread_t *thread) {
+  atomic_store(&thread->local_epoch, 0);
+  atomic_store(&thread->in_use, false);
+}
+
+bool coctree_insert(coct_thread_t *thread, point_t point) {
+  cnode_t *node = thread->tree->root;
+  if (!point_in_cuboid(point, node->boundary))
+    return false;
+  epoch_enter(thread);
+  int depth = 0;
+  for (;;) {
+    cbody_t *body = atomic_load_explicit(&node->body, memory_order_acquire);
+    if (body->is_branch) {
+      node = body->children[point_get_octant(node->boundary, point)];
+      depth++;
+      continue;
+    }
+    // full leaves split first, then the insert descends into the new branch
+    bool split = body->count >= LEAF_CAPACITY && depth < OCT_MAX_DEPTH - 1 &&
+                 cuboid_divisible(node->boundary);
+    cbody_t *next =
+        split ? body_branch_from(node, body) : body_leaf_with(body, point);
+    if (atomic_compare_exchange_strong_explicit(&node->body, &body, next,
+                                                memory_order_acq_rel,
+                                                memory_order_acquire)) {
+      retire(thread, body);
+      if (!split)
+        break;
+    } else {
+      body_discard(next);
+    }
+  }
+  epoch_leave(thread);
+  return true;
+}
+
+static void cnode_nearest_neighbor(cnode_t *node, point_t query,
+                                   point_t *nearest,
+                                   double *best_dist_squared) {
+  cbody_t *body = atomic_load_explicit(&node->body, memory_order_acquire);
+  if (!body->is_branch) {
+    for (size_t i = 0; i < body->count; ++i) {
+      double dist_sq = distance_sq(body->points[i], query);
+      if (dist_sq < *best_dist_squared) {
+        *best_dist_squared = dist_sq;
+        *nearest = body->points[i];
+      }
+    }
+    return;
+  }
+  int octant = point_get_octant(node->boundary, query);
+  cnode_nearest_neighbor(body->children[octant], query, nearest,
+                         best_dist_squared);
+  for (int i = 0; i < 8; ++i) {
+    if (i != octant && cuboid_distance_sq(body->children[i]->boundary, query) <
+                           *best_dist_squared)
+      cnode_nearest_neighbor(body->children[i], query, nearest,
+                             best_dist_squared);
+  }
+}
+
+point_t coctree_nearest_neighbor(coct_thread_t *thread, point_t query) {
+  point_t nearest = {0};
+  double best_dist_squared = DBL_MAX;
+  epoch_enter(thread);
+  cnode_nearest_neighbor(thread->tree->root, query, &nearest,
+                         &best_dist_squared);
+  epoch_leave(thread);
+  return nearest;
+}
+
+static void cnode_radius_query(cnode_t *node, point_t center, double radius_sq,
+                               point_t *out, size_t max_out, size_t *found) {
+  cbody_t *body = atomic_load_explicit(&node->body, memory_order_acquire);
+  if (!body->is_branch) {
+    for (size_t i = 0; i < body->count; ++i) {
+      if (distance_sq(body->points[i], center) <= radius_sq) {
+        if (*found < max_out)
+          out[*found] = body->points[i];
+        (*found)++;
+      }
+    }
+    return;
+  }
+  for (int i = 0; i < 8; ++i) {
+    if (cuboid_distance_sq(body->children[i]->boundary, center) <= radius_sq)
+      cnode_radius_query(body->children[i], center, radius_sq, out, max_out,
+                         found);
+  }
+}
+
+/**
+ * Returns the number of points within radius of center. At most max_out of
+ * them are copied to out, which may be NULL when max_out is 0.
+ */
+size_t coctree_radius_query(coct_thread_t *thread, point_t center,
+                            double radius, point_t *out, size_t max_out) {
+  size_t found = 0;
+  epoch_enter(thread);
+  cnode_radius_query(thread->tree->root, center, radius * radius, out, max_out,
+                     &found);
+  epoch_leave(thread);
+  return found;
+}
@@ -0,0 +1,68 @@
+#ifndef COCTREE_H
+#define COCTREE_H
+
+#include "oct.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/**
+ * Concurrent octree. Each node owns one atomic pointer to an immutable body,
+ * either a leaf (points) or a branch (8 fully built children). Writers build
+ * a new body and publish it with a single CAS, so readers that load a body
+ * always see a consistent node and never retry. Replaced leaf bodies are
+ * reclaimed with epoch-based reclamation once no reader can still hold them.
+ */
+
+#define COCT_MAX_THREADS 64
+#define COCT_CACHE_LINE 64
+
+struct cnode;
+
+typedef struct {
+  bool is_branch;
+  struct cnode *children[8]; // branch only
+  size_t count;              // leaf only
+  point_t points[];          // leaf only, sized at allocation
+} cbody_t;
+
+typedef struct cnode {
+  cuboid_t boundary;
+  _Atomic(cbody_t *) body;
+} cnode_t;
+
+typedef struct retired {
+  cbody_t *body;
+  struct retired *next;
+} retired_t;
+
+/**
+ * Per-thread handle, obtained once per thread before touching the tree.
+ * Each handle starts on its own cache line since local_epoch is written on
+ * every operation.
+ */
+typedef struct {
+  _Alignas(COCT_CACHE_LINE) atomic_bool in_use;
+  atomic_ulong local_epoch; // (epoch << 1) | 1 while inside a critical section
+  retired_t *limbo[3];      // bodies retired in each of the last 3 epochs
+  unsigned long limbo_epoch[3];
+  unsigned retire_count;
+  struct coctree *tree;
+} coct_thread_t;
+
+typedef struct coctree {
+  cnode_t *root;
+  atomic_ulong epoch; // read on every operation, written rarely
+  coct_thread_t threads[COCT_MAX_THREADS];
+} coctree_t;
+
+coctree_t *coctree_new(cuboid_t boundary);
+void coctree_free(coctree_t *tree);
+coct_thread_t *coctree_thread_register(coctree_t *tree);
+void coctree_thread_unregister(coct_thread_t *thread);
+bool coctree_insert(coct_thread_t *thread, point_t point);
+point_t coctree_nearest_neighbor(coct_thread_t *thread, point_t query);
+size_t coctree_radius_query(coct_thread_t *thread, point_t center,
+                            double radius, point_t *out, size_t max_out);
+
+#endif // COCTREE_H
@@ -1,16 +1,22 @@
 #include "camera.h"
 #include "oct.h"
+#include "prof.h"
 #include "sdl_wrapper.h"
 #include "utils.h"
 
 int main() {
   scene_background(0, 50, 180);
   scene_init(0, 0, 600, 80, 70);
-  for (int i = 0; i < 3000 + xrandom() % 2000; ++i) {
-    sphere_t sphere = sphere_make(
-        -600 + xrandom() % 1200, -400 + xrandom() % 800, 800 + xrandom() % 800,
-        8, 150 + xrandom() % 50, 150 + xrandom() % 50, 150 + xrandom() % 50);
-    sphere_write(&sphere);
+  {
+    PROF_SCOPE("scene_rasterize");
+    for (int i = 0; i < 3000 + xrandom() % 2000; ++i) {
+      sphere_t sphere = sphere_make(-600 + xrandom() % 1200,
+                                    -400 + xrandom() % 800,
+                                    800 + xrandom() % 800, 8,
+                                    150 + xrandom() % 50, 150 + xrandom() % 50,
+                                    150 + xrandom() % 50);
+      sphere_write(&sphere);
+    }
   }
 
   int width = scene.camera.boundary.width;
@@ -31,6 +37,10 @@ int main() {
   // Uncomment to view the buffer as .ppm file
   // pbuffer_save("output.ppm");
 
+  // Built with -DPROF_ENABLED, report where the time went
+  PROF_SUMMARY(stdout);
+  PROF_DUMP_TRACE("trace.json");
+
   // Cleanup
   buffer_free();
   sdl_context_release(context);
@@ -1,4 +1,5 @@
 #include "oct.h"
+#include "prof.h"
 #include <float.h>
 #include <math.h>
 #include <stdbool.h>
@@ -6,29 +7,29 @@
 #include <stdlib.h>
 
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
 
 node_t *node_new(cuboid_t *boundary);
 static bool node_is_leaf(node_t *node);
-static void node_insert(node_t *node, point_t point);
+static bool node_insert(octree_t *octree, node_t *node, point_t point,
+                        int depth);
 static void node_nearest_neighbor(node_t *node, point_t query, point_t *nearest,
                                   double *best_dist_squared);
-static bool point_in_cuboid(point_t point, cuboid_t boundary);
-static void cuboid_divide(cuboid_t *src, cuboid_t *dest);
-static int point_get_octant(cuboid_t cuboid, point_t point);
-static double distance_sq(point_t p1, point_t p2);
-
-static double distance_sq(point_t p1, point_t p2) {
-  return (p1.x - p2.x) * (p1.x - p2.x) + (p1.y - p2.y) * (p1.y - p2.y) +
-         (p1.z - p2.z) * (p1.z - p2.z);
+
+// widened before squaring so that far apart coordinates cannot overflow int
+double distance_sq(point_t p1, point_t p2) {
+  return (double)(p1.x - p2.x) * (p1.x - p2.x) +
+         (double)(p1.y - p2.y) * (p1.y - p2.y) +
+         (double)(p1.z - p2.z) * (p1.z - p2.z);
 }
 
-static bool point_in_cuboid(point_t point, cuboid_t boundary) {
+bool point_in_cuboid(point_t point, cuboid_t boundary) {
   return point.x >= boundary.x0 && point.x <= boundary.x1 &&
          point.y >= boundary.y0 && point.y <= boundary.y1 &&
          point.z >= boundary.z0 && point.z <= boundary.z1;
 }
 
-static void cuboid_divide(cuboid_t *src, cuboid_t *dest) {
+void cuboid_divide(cuboid_t *src, cuboid_t *dest) {
   int mid_x = (src->x0 + src->x1) / 2;
   int mid_y = (src->y0 + src->y1) / 2;
   int mid_z = (src->z0 + src->z1) / 2;
@@ -44,7 +45,7 @@ static void cuboid_divide(cuboid_t *src, cuboid_t *dest) {
       (cuboid_t){mid_x + 1, mid_y + 1, mid_z + 1, src->x1, src->y1, src->z1};
 }
 
-static int point_get_octant(cuboid_t cuboid, point_t point) {
+int point_get_octant(cuboid_t cuboid, point_t point) {
   int mid_x = (cuboid.x0 + cuboid.x1) / 2;
   int mid_y = (cuboid.y0 + cuboid.y1) / 2;
   int mid_z = (cuboid.z0 + cuboid.z1) / 2;
@@ -63,6 +64,7 @@ node_t *node_new(cuboid_t *boundary) {
   node_t *node = malloc(sizeof(node_t));
   node->boundary = *boundary;
   node->count = 0;
+  node->is_occupied = false;
   node->points = malloc(MAX_CHILDREN * sizeof(point_t));
   for (int i = 0; i < 8; ++i)
     node->children[i] = NULL;
@@ -78,12 +80,19 @@ static bool node_is_leaf(node_t *node) {
   return true;
 }
 
-static void node_insert(node_t *node, point_t point) {
+static bool node_insert(octree_t *octree, node_t *node, point_t point,
+                        int depth) {
   if (!point_in_cuboid(point, node->boundary))
-    return;
-  if (node->count < 4 && node_is_leaf(node)) {
+    return false;
+  int level = MIN(depth, OCT_MAX_DEPTH - 1);
+  if (!node->is_occupied) {
+    node->is_occupied = true;
+    octree->occupied[level]++;
+  }
+  if (node->count < LEAF_CAPACITY && node_is_leaf(node)) {
     node->points[node->count++] = point;
-    return;
+    octree->leaf_points[level]++;
+    return true;
   }
 
   if (node_is_leaf(node)) {
@@ -92,20 +101,22 @@ static void node_insert(node_t *node, point_t point) {
     for (int i = 0; i < 8; ++i) {
       node->children[i] = node_new(&subcuboids[i]);
     }
+    octree->leaf_points[level] -= node->count;
     for (int i = 0; i < node->count; ++i) {
       int octant = point_get_octant(node->boundary, node->points[i]);
-      node_insert(node->children[octant], node->points[i]);
+      node_insert(octree, node->children[octant], node->points[i], depth + 1);
     }
     node->count = 0;
   }
   int octant = point_get_octant(node->boundary, point);
-  node_insert(node->children[octant], point);
+  return node_insert(octree, node->children[octant], point, depth + 1);
 }
 
 static void node_nearest_neighbor(node_t *node, point_t query, point_t *nearest,
                                   double *best_dist_squared) {
   if (!node)
     return;
+  PROF_COUNT(PROF_OCT_NODES_VISITED, 1);
   for (size_t i = 0; i < node->count; ++i) {
     double dist_sq = distance_sq(node->points[i], query);
     if (dist_sq < *best_dist_squared) {
@@ -128,17 +139,38 @@ static void node_nearest_neighbor(node_t *node, point_t query, point_t *nearest,
 }
 
 // wrapper functions
-void octree_insert(octree_t *octree, point_t point) {
-  node_insert(octree->root, point);
+bool octree_insert(octree_t *octree, point_t point) {
+  return node_insert(octree, octree->root, point, 0);
 }
 
 point_t octree_nearest_neighbor(octree_t *octree, point_t query) {
   point_t nearest = {0};
   double best_dist_squared = DBL_MAX;
+  uint64_t visited = PROF_COUNTER_GET(PROF_OCT_NODES_VISITED);
   node_nearest_neighbor(octree->root, query, &nearest, &best_dist_squared);
+  PROF_COUNT(PROF_OCT_NN_CALLS, 1);
+  PROF_HIST(PROF_HIST_OCT_NN_VISITS,
+            PROF_COUNTER_GET(PROF_OCT_NODES_VISITED) - visited);
   return nearest;
 }
 
+static void node_profile(node_t *node, int depth) {
+  if (node_is_leaf(node)) {
+    PROF_HIST(PROF_HIST_OCT_DEPTH, depth);
+    PROF_HIST(PROF_HIST_LEAF_OCCUPANCY, node->count);
+    return;
+  }
+  for (int i = 0; i < 8; ++i) {
+    if (node->children[i])
+      node_profile(node->children[i], depth + 1);
+  }
+}
+
+void octree_profile(octree_t *octree) {
+  if (octree && octree->root)
+    node_profile(octree->root, 0);
+}
+
 static void node_free(node_t *node) {
   if (!node)
     return;
@@ -4,8 +4,11 @@
 #include <stdlib.h>
 #include <math.h>
 #include <float.h>
+#include <stdbool.h>
 
 #define MAX_CHILDREN 8
+#define LEAF_CAPACITY 4
+#define OCT_MAX_DEPTH 32
 typedef struct {
   int x0, y0, z0, x1, y1, z1;
 } cuboid_t;
@@ -18,18 +21,31 @@ typedef struct {
 typedef struct node {
   cuboid_t boundary;
   size_t count;
+  bool is_occupied; // a point has been inserted below this node
   point_t *points;
   struct node *children[8];
 } node_t;
 
 typedef struct {
   node_t *root;
+  // Box counting. occupied[d] counts the non-empty nodes at depth d, but a
+  // point held by a leaf shallower than d is not yet in any depth-d node;
+  // leaf_points[d] counts the points held by leaves at depth d so callers
+  // can bound how many depth-d boxes are still missing.
+  size_t occupied[OCT_MAX_DEPTH];
+  size_t leaf_points[OCT_MAX_DEPTH];
 } octree_t;
 
+bool point_in_cuboid(point_t point, cuboid_t boundary);
+void cuboid_divide(cuboid_t *src, cuboid_t *dest);
+int point_get_octant(cuboid_t cuboid, point_t point);
+double distance_sq(point_t p1, point_t p2);
 node_t *node_new(cuboid_t *boundary);
 void octree_free(octree_t *tree);
-void octree_insert(octree_t *octree, point_t point);
+bool octree_insert(octree_t *octree, point_t point);
 point_t octree_nearest_neighbor(octree_t *octree, point_t query);
+/** Records leaf depth and occupancy histograms (needs PROF_ENABLED) */
+void octree_profile(octree_t *octree);
 
 #endif // OCTREE_H
 
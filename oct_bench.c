@@ -0,0 +1,202 @@
+#include "coct.h"
+#include "oct.h"
+#include <float.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Scaling benchmark and stress run for the concurrent octree. Every thread
+// mixes inserts with nearest neighbor queries. The benchmark spreads points
+// over a large domain; the stress run packs them into a few cells so that
+// writers keep racing on the same leaves and splits, and checks every reader
+// result against a brute force scan. `oct_bench stress` runs the stress run
+// alone.
+
+#define BENCH_SIDE 1024
+#define BENCH_PREFILL 100000
+#define BENCH_OPS 1000000
+#define BENCH_INSERT_PERCENT 10
+
+#define STRESS_SIDE 16
+#define STRESS_PREFILL 1000
+#define STRESS_OPS 40000
+#define STRESS_INSERT_PERCENT 50
+#define STRESS_FINAL_QUERIES 2000
+
+typedef struct {
+  int side;
+  size_t prefill, ops;
+  int insert_percent;
+  bool verify; // check each query against the prefilled snapshot
+} config_t;
+
+typedef struct {
+  coctree_t *tree;
+  const config_t *config;
+  point_t *points; // every point ever inserted, indexed by id
+  unsigned long long rng;
+  size_t ops;
+  size_t id_base;
+  size_t inserted_count;
+  size_t errors;
+} worker_t;
+
+static void *alloc_or_die(size_t size) {
+  void *ptr = malloc(size);
+  if (!ptr) {
+    fprintf(stderr, "Memory allocation failed for benchmark\n");
+    abort();
+  }
+  return ptr;
+}
+
+// per-thread generator; the one in utils.h has global state
+static int worker_random(worker_t *worker) {
+  worker->rng = worker->rng * 0x3243f6a8885a308dull + 1;
+  return worker->rng >> 33;
+}
+
+static point_t worker_point(worker_t *worker) {
+  int side = worker->config->side;
+  return (point_t){worker_random(worker) % side, worker_random(worker) % side,
+                   worker_random(worker) % side, 0};
+}
+
+static double brute_force_sq(const point_t *points, size_t count,
+                             point_t query) {
+  double best = DBL_MAX;
+  for (size_t i = 0; i < count; ++i) {
+    double dist_sq = distance_sq(points[i], query);
+    if (dist_sq < best)
+      best = dist_sq;
+  }
+  return best;
+}
+
+// a result must be a real inserted point and no farther than the snapshot
+static bool result_valid(worker_t *worker, point_t query, point_t nearest) {
+  const point_t *known = &worker->points[nearest.id];
+  if (known->x != nearest.x || known->y != nearest.y || known->z != nearest.z)
+    return false;
+  return distance_sq(nearest, query) <=
+         brute_force_sq(worker->points, worker->config->prefill, query);
+}
+
+static void *worker_run(void *arg) {
+  worker_t *worker = arg;
+  coct_thread_t *thread = coctree_thread_register(worker->tree);
+  if (!thread)
+    return NULL;
+  for (size_t i = 0; i < worker->ops; ++i) {
+    point_t point = worker_point(worker);
+    if (worker_random(worker) % 100 < worker->config->insert_percent) {
+      point.id = worker->id_base + worker->inserted_count++;
+      worker->points[point.id] = point;
+      coctree_insert(thread, point);
+    } else {
+      point_t nearest = coctree_nearest_neighbor(thread, point);
+      if (worker->config->verify && !result_valid(worker, point, nearest))
+        worker->errors++;
+    }
+  }
+  coctree_thread_unregister(thread);
+  return NULL;
+}
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool run(const char *name, const config_t *config, int thread_count) {
+  int side = config->side;
+  coctree_t *tree =
+      coctree_new((cuboid_t){0, 0, 0, side - 1, side - 1, side - 1});
+  if (!tree)
+    return false;
+  size_t ops = config->ops / thread_count;
+  size_t capacity = config->prefill + ops * thread_count;
+  point_t *points = alloc_or_die(capacity * sizeof(point_t));
+  worker_t prefill = {.tree = tree, .config = config, .rng = 1};
+  coct_thread_t *main_thread = coctree_thread_register(tree);
+  for (size_t i = 0; i < config->prefill; ++i) {
+    points[i] = worker_point(&prefill);
+    points[i].id = i;
+    coctree_insert(main_thread, points[i]);
+  }
+
+  pthread_t threads[COCT_MAX_THREADS];
+  worker_t workers[COCT_MAX_THREADS];
+  for (int i = 0; i < thread_count; ++i)
+    workers[i] = (worker_t){tree, config, points, 1000 + i, ops,
+                            config->prefill + i * ops, 0, 0};
+  double start = now_s();
+  for (int i = 0; i < thread_count; ++i)
+    pthread_create(&threads[i], NULL, worker_run, &workers[i]);
+  for (int i = 0; i < thread_count; ++i)
+    pthread_join(threads[i], NULL);
+  double elapsed = now_s() - start;
+
+  // nothing inserted concurrently may have been lost
+  size_t expected = config->prefill, missing = 0, errors = 0;
+  for (int i = 0; i < thread_count; ++i) {
+    errors += workers[i].errors;
+    for (size_t j = 0; j < workers[i].inserted_count; ++j) {
+      point_t point = points[workers[i].id_base + j];
+      point_t found[64];
+      size_t n = coctree_radius_query(main_thread, point, 0, found, 64);
+      bool present = false;
+      for (size_t k = 0; k < n && k < 64; ++k)
+        present |= found[k].id == point.id;
+      missing += !present;
+    }
+    expected += workers[i].inserted_count;
+  }
+  size_t total = coctree_radius_query(main_thread, (point_t){0, 0, 0, 0},
+                                      3.0 * side, NULL, 0);
+
+  // once quiescent, queries must match a scan over everything inserted
+  if (config->verify) {
+    point_t *all = alloc_or_die(expected * sizeof(point_t));
+    size_t count = 0;
+    for (size_t i = 0; i < config->prefill; ++i)
+      all[count++] = points[i];
+    for (int i = 0; i < thread_count; ++i) {
+      for (size_t j = 0; j < workers[i].inserted_count; ++j)
+        all[count++] = points[workers[i].id_base + j];
+    }
+    for (int i = 0; i < STRESS_FINAL_QUERIES; ++i) {
+      point_t query = worker_point(&prefill);
+      point_t nearest = coctree_nearest_neighbor(main_thread, query);
+      errors +=
+          distance_sq(nearest, query) != brute_force_sq(all, count, query);
+    }
+    free(all);
+  }
+  printf("%s %2d threads: %8.3f Mops/s, %zu points, %zu missing, %zu wrong\n",
+         name, thread_count, config->ops / elapsed / 1e6, total, missing,
+         errors);
+  coctree_thread_unregister(main_thread);
+  coctree_free(tree);
+  free(points);
+  return total == expected && missing == 0 && errors == 0;
+}
+
+int main(int argc, char **argv) {
+  bool stress_only = argc > 1 && !strcmp(argv[1], "stress");
+  const config_t bench = {BENCH_SIDE, BENCH_PREFILL, BENCH_OPS,
+                          BENCH_INSERT_PERCENT, false};
+  const config_t stress = {STRESS_SIDE, STRESS_PREFILL, STRESS_OPS,
+                           STRESS_INSERT_PERCENT, true};
+  bool ok = true;
+  for (int threads = 1; threads <= 32; threads *= 2)
+    ok &= run("stress", &stress, threads);
+  for (int threads = 1; threads <= 32 && !stress_only; threads *= 2)
+    ok &= run("bench ", &bench, threads);
+  if (!ok)
+    fprintf(stderr, "Concurrent octree lost points or gave wrong results\n");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,278 @@
+#include "prof.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef PROF_ENABLED
+
+#define PROF_MAX_ZONES 64
+#define PROF_MAX_EVENTS (1 << 16)
+#define PROF_MAX_FRAMES (1 << 14)
+
+typedef struct {
+  const char *name;
+  atomic_ullong calls;
+  atomic_ullong total_ns;
+  atomic_ullong max_ns;
+} zone_stats_t;
+
+typedef struct {
+  int id, tid;
+  uint64_t start_ns, dur_ns;
+} zone_event_t;
+
+typedef struct {
+  uint64_t ts_ns;
+  uint64_t spheres, pixels;
+} frame_event_t;
+
+_Thread_local prof_local_t prof_local;
+
+static const char *counter_names[PROF_COUNTER_COUNT] = {
+    "walker_steps",        "walkers_stuck",      "oct_nn_calls",
+    "oct_nodes_visited",   "spheres_rasterized", "pixels_rasterized"};
+static const char *hist_names[PROF_HIST_COUNT] = {
+    "walker_steps_per_stuck", "oct_nodes_per_nn", "oct_leaf_depth",
+    "oct_leaf_occupancy"};
+// log2 bins for unbounded quantities, one bin per value for small ones
+static const int hist_is_log[PROF_HIST_COUNT] = {1, 1, 0, 0};
+
+// registered thread blocks and the totals of threads that already exited
+static pthread_mutex_t threads_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t threads_once = PTHREAD_ONCE_INIT;
+static pthread_key_t thread_key;
+static prof_local_t *threads = NULL;
+static prof_local_t exited;
+static atomic_int next_tid = 0;
+
+static zone_stats_t zones[PROF_MAX_ZONES];
+static int zone_count = 0;
+static zone_event_t events[PROF_MAX_EVENTS];
+static atomic_size_t event_count = 0, events_dropped = 0;
+// frames come from the render thread only
+static frame_event_t frames[PROF_MAX_FRAMES];
+static size_t frame_count = 0;
+static uint64_t frame_base[PROF_COUNTER_COUNT];
+// set once by threads_init; every thread passes through pthread_once before
+// its first timestamp, so later reads need no synchronization
+static uint64_t epoch_ns = 0;
+
+static uint64_t clock_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint64_t now_ns(void) { return clock_ns() - epoch_ns; }
+
+static void local_merge(prof_local_t *dest, const prof_local_t *src) {
+  for (int i = 0; i < PROF_COUNTER_COUNT; ++i)
+    dest->counters[i] += src->counters[i];
+  for (int h = 0; h < PROF_HIST_COUNT; ++h) {
+    for (int b = 0; b < PROF_HIST_BINS; ++b)
+      dest->hists[h][b] += src->hists[h][b];
+  }
+}
+
+// a thread's block dies with it, so fold it into the totals on exit
+static void thread_exit(void *arg) {
+  prof_local_t *local = arg;
+  pthread_mutex_lock(&threads_lock);
+  local_merge(&exited, local);
+  for (prof_local_t **it = &threads; *it; it = &(*it)->next) {
+    if (*it == local) {
+      *it = local->next;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&threads_lock);
+}
+
+static void threads_init(void) {
+  epoch_ns = clock_ns();
+  pthread_key_create(&thread_key, thread_exit);
+}
+
+void prof_thread_register(void) {
+  pthread_once(&threads_once, threads_init);
+  pthread_mutex_lock(&threads_lock);
+  prof_local.registered = true;
+  prof_local.tid = atomic_fetch_add(&next_tid, 1);
+  prof_local.next = threads;
+  threads = &prof_local;
+  pthread_mutex_unlock(&threads_lock);
+  pthread_setspecific(thread_key, &prof_local);
+}
+
+static int log2_bin(uint64_t value) {
+  int bin = 0;
+  while (value > 1 && bin < PROF_HIST_BINS - 1) {
+    value >>= 1;
+    ++bin;
+  }
+  return bin;
+}
+
+static int prof_zone_register(const char *name) {
+  pthread_mutex_lock(&threads_lock);
+  int id = -1;
+  for (int i = 0; i < zone_count && id < 0; ++i) {
+    if (strcmp(zones[i].name, name) == 0)
+      id = i;
+  }
+  if (id < 0 && zone_count < PROF_MAX_ZONES) {
+    zones[zone_count].name = name;
+    id = zone_count++;
+  }
+  pthread_mutex_unlock(&threads_lock);
+  return id;
+}
+
+prof_zone_t prof_zone_begin(atomic_int *id, const char *name) {
+  // each call site resolves its zone once and caches the index
+  int zone = atomic_load_explicit(id, memory_order_acquire);
+  if (zone < 0) {
+    zone = prof_zone_register(name);
+    atomic_store_explicit(id, zone, memory_order_release);
+  }
+  if (!prof_local.registered)
+    prof_thread_register();
+  return (prof_zone_t){zone, now_ns()};
+}
+
+void prof_zone_end(prof_zone_t *zone) {
+  if (zone->id < 0)
+    return;
+  uint64_t dur = now_ns() - zone->start_ns;
+  zone_stats_t *stats = &zones[zone->id];
+  atomic_fetch_add_explicit(&stats->calls, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&stats->total_ns, dur, memory_order_relaxed);
+  unsigned long long max = atomic_load_explicit(&stats->max_ns,
+                                                memory_order_relaxed);
+  while (dur > max && !atomic_compare_exchange_weak_explicit(
+                          &stats->max_ns, &max, dur, memory_order_relaxed,
+                          memory_order_relaxed))
+    ;
+  size_t slot = atomic_fetch_add_explicit(&event_count, 1, memory_order_relaxed);
+  if (slot < PROF_MAX_EVENTS)
+    events[slot] =
+        (zone_event_t){zone->id, prof_local.tid, zone->start_ns, dur};
+  else
+    atomic_fetch_add_explicit(&events_dropped, 1, memory_order_relaxed);
+}
+
+void prof_hist_add(prof_hist_t hist, uint64_t value) {
+  if (!prof_local.registered)
+    prof_thread_register();
+  int bin = hist_is_log[hist] ? log2_bin(value)
+                              : (value < PROF_HIST_BINS ? (int)value
+                                                        : PROF_HIST_BINS - 1);
+  prof_local.hists[hist][bin]++;
+}
+
+// per-frame deltas are taken from the calling (render) thread's counters
+void prof_frame_end(void) {
+  if (!prof_local.registered)
+    prof_thread_register();
+  const uint64_t *counters = prof_local.counters;
+  if (frame_count < PROF_MAX_FRAMES) {
+    frames[frame_count++] = (frame_event_t){
+        now_ns(),
+        counters[PROF_SPHERES_RASTERIZED] - frame_base[PROF_SPHERES_RASTERIZED],
+        counters[PROF_PIXELS_RASTERIZED] - frame_base[PROF_PIXELS_RASTERIZED]};
+  }
+  memcpy(frame_base, counters, sizeof(frame_base));
+}
+
+// call once the instrumented threads are idle
+void prof_summary(FILE *out) {
+  pthread_mutex_lock(&threads_lock);
+  prof_local_t total = exited;
+  for (prof_local_t *it = threads; it; it = it->next)
+    local_merge(&total, it);
+  pthread_mutex_unlock(&threads_lock);
+
+  fprintf(out, "--- profile summary ---\n");
+  for (int i = 0; i < PROF_COUNTER_COUNT; ++i)
+    fprintf(out, "%-22s %llu\n", counter_names[i],
+            (unsigned long long)total.counters[i]);
+  if (frame_count) {
+    // only frames that rasterized something; the rest just re-upload
+    fprintf(out, "%-22s %zu\n", "frames", frame_count);
+    for (size_t i = 0; i < frame_count; ++i) {
+      if (frames[i].spheres || frames[i].pixels)
+        fprintf(out, "  frame %zu: %llu spheres, %llu pixels\n", i,
+                (unsigned long long)frames[i].spheres,
+                (unsigned long long)frames[i].pixels);
+    }
+  }
+  const uint64_t(*hists)[PROF_HIST_BINS] = total.hists;
+  for (int h = 0; h < PROF_HIST_COUNT; ++h) {
+    uint64_t count = 0;
+    for (int b = 0; b < PROF_HIST_BINS; ++b)
+      count += hists[h][b];
+    if (!count)
+      continue;
+    fprintf(out, "%s:\n", hist_names[h]);
+    for (int b = 0; b < PROF_HIST_BINS; ++b) {
+      if (!hists[h][b])
+        continue;
+      if (hist_is_log[h])
+        fprintf(out, "  [%llu, %llu) %llu\n", b ? 1ull << b : 0ull,
+                2ull << b, (unsigned long long)hists[h][b]);
+      else
+        fprintf(out, "  %d %llu\n", b, (unsigned long long)hists[h][b]);
+    }
+  }
+  for (int i = 0; i < zone_count; ++i) {
+    zone_stats_t *z = &zones[i];
+    unsigned long long calls = atomic_load(&z->calls);
+    unsigned long long total_ns = atomic_load(&z->total_ns);
+    if (!calls)
+      continue;
+    fprintf(out, "%-22s %llu calls, total %.3f ms, mean %.3f us, max %.3f us\n",
+            z->name, calls, total_ns / 1e6, total_ns / 1e3 / calls,
+            atomic_load(&z->max_ns) / 1e3);
+  }
+  size_t dropped = atomic_load(&events_dropped);
+  if (dropped)
+    fprintf(out, "trace events dropped: %zu\n", dropped);
+}
+
+int prof_dump_trace(const char *filename) {
+  FILE *file = fopen(filename, "w");
+  if (!file) {
+    perror("Error opening trace file");
+    return -1;
+  }
+  // Chrome trace event format; timestamps are in microseconds
+  fprintf(file, "{\"traceEvents\":[\n");
+  const char *sep = "";
+  size_t count = atomic_load(&event_count);
+  if (count > PROF_MAX_EVENTS)
+    count = PROF_MAX_EVENTS;
+  for (size_t i = 0; i < count; ++i) {
+    fprintf(file,
+            "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+            "\"ts\":%.3f,\"dur\":%.3f}",
+            sep, zones[events[i].id].name, events[i].tid,
+            events[i].start_ns / 1e3, events[i].dur_ns / 1e3);
+    sep = ",\n";
+  }
+  for (size_t i = 0; i < frame_count; ++i) {
+    fprintf(file,
+            "%s{\"name\":\"frame\",\"ph\":\"C\",\"pid\":0,\"ts\":%.3f,"
+            "\"args\":{\"spheres\":%llu,\"pixels\":%llu}}",
+            sep, frames[i].ts_ns / 1e3, (unsigned long long)frames[i].spheres,
+            (unsigned long long)frames[i].pixels);
+    sep = ",\n";
+  }
+  fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+  fclose(file);
+  return 0;
+}
+
+#endif // PROF_ENABLED
@@ -0,0 +1,100 @@
+#ifndef PROF_H
+#define PROF_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Hot-path instrumentation. Everything below compiles away unless the build
+ * defines PROF_ENABLED (e.g. `make CFLAGS=-DPROF_ENABLED`).
+ */
+
+typedef enum {
+  PROF_WALKER_STEPS,       // random walk steps taken by all walkers
+  PROF_WALKERS_STUCK,      // walkers that attached to the cluster
+  PROF_OCT_NN_CALLS,       // octree_nearest_neighbor calls
+  PROF_OCT_NODES_VISITED,  // nodes visited by all nearest neighbor searches
+  PROF_SPHERES_RASTERIZED, // spheres passed to sphere_write
+  PROF_PIXELS_RASTERIZED,  // visible pixels written by sphere_write
+  PROF_COUNTER_COUNT
+} prof_counter_t;
+
+typedef enum {
+  PROF_HIST_WALKER_STEPS,   // steps per stuck particle, log2 bins
+  PROF_HIST_OCT_NN_VISITS,  // nodes visited per nearest neighbor call, log2
+  PROF_HIST_OCT_DEPTH,      // leaf depth, linear bins
+  PROF_HIST_LEAF_OCCUPANCY, // points per leaf, linear bins
+  PROF_HIST_COUNT
+} prof_hist_t;
+
+#define PROF_HIST_BINS 64
+
+typedef struct {
+  int id;
+  uint64_t start_ns;
+} prof_zone_t;
+
+#ifdef PROF_ENABLED
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+/**
+ * Counters and histograms are per thread, so the hot path never shares a
+ * cache line. Each thread registers its block on first use and the blocks
+ * are merged by prof_summary.
+ */
+typedef struct prof_local {
+  bool registered;
+  int tid;
+  uint64_t counters[PROF_COUNTER_COUNT];
+  uint64_t hists[PROF_HIST_COUNT][PROF_HIST_BINS];
+  struct prof_local *next;
+} prof_local_t;
+
+extern _Thread_local prof_local_t prof_local;
+
+void prof_thread_register(void);
+prof_zone_t prof_zone_begin(atomic_int *id, const char *name);
+void prof_zone_end(prof_zone_t *zone);
+void prof_hist_add(prof_hist_t hist, uint64_t value);
+void prof_frame_end(void);
+void prof_summary(FILE *out);
+int prof_dump_trace(const char *filename);
+
+static inline void prof_count(prof_counter_t counter, uint64_t n) {
+  if (!prof_local.registered)
+    prof_thread_register();
+  prof_local.counters[counter] += n;
+}
+
+#define PROF_CONCAT_(a, b) a##b
+#define PROF_CONCAT(a, b) PROF_CONCAT_(a, b)
+
+#define PROF_COUNT(counter, n) prof_count(counter, n)
+/** Value of a counter for the calling thread only */
+#define PROF_COUNTER_GET(counter) (prof_local.counters[counter])
+#define PROF_HIST(hist, value) prof_hist_add(hist, value)
+/** Times the rest of the enclosing block, including early returns */
+#define PROF_SCOPE(name)                                                       \
+  static atomic_int PROF_CONCAT(prof_id_, __LINE__) = -1;                      \
+  prof_zone_t PROF_CONCAT(prof_zone_, __LINE__)                                \
+      __attribute__((cleanup(prof_zone_end))) =                                \
+          prof_zone_begin(&PROF_CONCAT(prof_id_, __LINE__), name)
+#define PROF_FRAME_END() prof_frame_end()
+#define PROF_SUMMARY(out) prof_summary(out)
+#define PROF_DUMP_TRACE(filename) ((void)prof_dump_trace(filename))
+
+#else
+
+#define PROF_COUNT(counter, n) ((void)0)
+#define PROF_COUNTER_GET(counter) ((uint64_t)0)
+#define PROF_HIST(hist, value) ((void)sizeof(value))
+#define PROF_SCOPE(name) ((void)0)
+#define PROF_FRAME_END() ((void)0)
+#define PROF_SUMMARY(out) ((void)0)
+#define PROF_DUMP_TRACE(filename) ((void)0)
+
+#endif // PROF_ENABLED
+
+#endif // PROF_H
@@ -1,4 +1,5 @@
 #include "sdl_wrapper.h"
+#include "prof.h"
 #include <SDL2/SDL.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -85,27 +86,32 @@ bool sdl_context_render(sdl_context_t *context, uint32_t **img_raw, int width,
     }
   }
 
-  void *pixels;
-  int pitch;
-  if (SDL_LockTexture(context->texture, NULL, &pixels, &pitch) != 0) {
-    printf("SDL_LockTexture failed: %s\n", SDL_GetError());
-    return is_done;
-  }
+  {
+    PROF_SCOPE("texture_upload");
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(context->texture, NULL, &pixels, &pitch) != 0) {
+      printf("SDL_LockTexture failed: %s\n", SDL_GetError());
+      PROF_FRAME_END();
+      return is_done;
+    }
 
-  int wwidth = 0, wheight = 0;
-  SDL_GetWindowSize(context->window, &wwidth, &wheight);
-  for (int r = 0; r < wheight; ++r) {
-    uint32_t *row = (uint32_t *)((uint8_t *)pixels + r * pitch);
-    int r_idx =
-        MIN(MAX(lmap_int(r, 0, wheight - 1, 0, height - 1), 0), height - 1);
-    for (int c = 0; c < wwidth; ++c) {
-      int c_idx =
-          MIN(MAX(lmap_int(c, 0, wwidth - 1, 0, width - 1), 0), width - 1);
-      row[c] = img_raw[r_idx][c_idx];
+    int wwidth = 0, wheight = 0;
+    SDL_GetWindowSize(context->window, &wwidth, &wheight);
+    for (int r = 0; r < wheight; ++r) {
+      uint32_t *row = (uint32_t *)((uint8_t *)pixels + r * pitch);
+      int r_idx =
+          MIN(MAX(lmap_int(r, 0, wheight - 1, 0, height - 1), 0), height - 1);
+      for (int c = 0; c < wwidth; ++c) {
+        int c_idx =
+            MIN(MAX(lmap_int(c, 0, wwidth - 1, 0, width - 1), 0), width - 1);
+        row[c] = img_raw[r_idx][c_idx];
+      }
     }
-  }
 
-  SDL_UnlockTexture(context->texture);
+    SDL_UnlockTexture(context->texture);
+  }
+  PROF_FRAME_END();
   // Render the texture
   SDL_RenderClear(context->renderer);
   SDL_RenderCopy(context->renderer, context->texture, NULL, NULL);